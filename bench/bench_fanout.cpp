@@ -0,0 +1,249 @@
+/**
+ * Fan-out benchmark: every message is delivered to N subscribers, each keeping the last kDepth messages.
+ *  - copy: each subscriber stores a copy of the message
+ *  - handle: each subscriber stores a MessagePool::Handle
+ *
+ * Two scenarios:
+ *  - fan-out: the received message is decoded (memcpy) into the receive buffer / a pool slot, then delivered.
+ *    No parsing, isolates the cost of the delivery.
+ *  - parse + fan-out: the whole path, frames parsed byte by byte by MsgProcessor / PooledMsgProcessor.
+ *
+ * Each case is run once for warm-up, then kRepetitions times; the median is reported.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "microparcel.h"
+
+static const uint32_t kFrames = 200000;
+static const uint8_t kDepth = 4;
+static const uint8_t kRepetitions = 9;
+
+// every subscriber holds kDepth messages, plus one being received
+static const uint8_t kPoolSize = kDepth + 1;
+
+// results are folded in here so that the stores to the subscribers can't be optimized out
+static volatile uint32_t sink;
+
+
+template <typename T>
+class Subscriber{
+    public:
+        Subscriber(): idx(0){}
+
+        void push(const T &in){
+            ring[idx] = in;
+            idx = (idx + 1) % kDepth;
+        }
+
+        T ring[kDepth];
+        uint8_t idx;
+};
+
+template <typename MsgType>
+uint32_t checksum(const MsgType &msg){
+    uint32_t cs = 0;
+    for(uint8_t i = 0; i < MsgType::kSize; i++){
+        cs += msg.data[i];
+    }
+    return cs;
+}
+
+template <typename MsgType, uint8_t NSubscribers>
+void drain(const Subscriber<MsgType> (&subscribers)[NSubscribers]){
+    uint32_t cs = 0;
+    for(uint8_t i = 0; i < NSubscribers; i++){
+        for(uint8_t d = 0; d < kDepth; d++){
+            cs += checksum(subscribers[i].ring[d]);
+        }
+    }
+    sink = sink + cs;
+}
+
+template <typename Handle, uint8_t NSubscribers>
+void drainHandles(const Subscriber<Handle> (&subscribers)[NSubscribers]){
+    uint32_t cs = 0;
+    for(uint8_t i = 0; i < NSubscribers; i++){
+        for(uint8_t d = 0; d < kDepth; d++){
+            cs += checksum(*subscribers[i].ring[d]);
+        }
+    }
+    sink = sink + cs;
+}
+
+void expectNoDrop(uint32_t inDropped){
+    if(inDropped != 0){
+        std::printf("error: %u messages dropped, results are not comparable\n", (unsigned)inDropped);
+        std::exit(1);
+    }
+}
+
+
+template <typename Implementation, typename MsgType>
+class FanOutRouter{
+    public:
+        void process(MsgType &msg){
+            static_cast<Implementation&>(*this).dispatch(msg);
+        }
+};
+
+template <typename MsgType, uint8_t NSubscribers>
+class CopyProcessor: public microparcel::MsgProcessor<CopyProcessor<MsgType, NSubscribers>, FanOutRouter<CopyProcessor<MsgType, NSubscribers>, MsgType>, MsgType>{
+    public:
+        void dispatch(MsgType &msg){
+            for(uint8_t i = 0; i < NSubscribers; i++){
+                subscribers[i].push(msg);
+            }
+        }
+
+        void drain() const { ::drain(subscribers); }
+        uint32_t getDroppedCount() const { return 0; }
+
+        Subscriber<MsgType> subscribers[NSubscribers];
+};
+
+template <typename MsgType, uint8_t NSubscribers>
+class HandleProcessor: public microparcel::PooledMsgProcessor<HandleProcessor<MsgType, NSubscribers>, FanOutRouter<HandleProcessor<MsgType, NSubscribers>, MsgType>, MsgType, kPoolSize>{
+    public:
+        using Base = microparcel::PooledMsgProcessor<HandleProcessor<MsgType, NSubscribers>, FanOutRouter<HandleProcessor<MsgType, NSubscribers>, MsgType>, MsgType, kPoolSize>;
+
+        void dispatch(MsgType &){
+            typename Base::Handle h = this->retainReceived();
+            for(uint8_t i = 0; i < NSubscribers; i++){
+                subscribers[i].push(h);
+            }
+        }
+
+        void drain() const { drainHandles(subscribers); }
+
+        Subscriber<typename Base::Handle> subscribers[NSubscribers];
+};
+
+
+template <typename MsgType>
+void fillPayload(MsgType &msg){
+    for(uint8_t i = 0; i < MsgType::kSize; i++){
+        msg.data[i] = i + 1;
+    }
+}
+
+template <typename Clock>
+double nsPerFrame(typename Clock::time_point start, typename Clock::time_point stop){
+    return std::chrono::duration<double, std::nano>(stop - start).count() / kFrames;
+}
+
+template <typename MsgType, uint8_t NSubscribers>
+double runFanOutCopy(){
+    MsgType src;
+    fillPayload(src);
+
+    MsgType recv;
+    Subscriber<MsgType> subscribers[NSubscribers];
+
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t f = 0; f < kFrames; f++){
+        src.data[0] = f;
+        std::memcpy(recv.data, src.data, MsgType::kSize);
+        for(uint8_t i = 0; i < NSubscribers; i++){
+            subscribers[i].push(recv);
+        }
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    drain(subscribers);
+    return nsPerFrame<std::chrono::steady_clock>(start, stop);
+}
+
+template <typename MsgType, uint8_t NSubscribers>
+double runFanOutHandle(){
+    using TPool = microparcel::MessagePool<MsgType, kPoolSize>;
+
+    MsgType src;
+    fillPayload(src);
+
+    TPool pool;
+    Subscriber<typename TPool::Handle> subscribers[NSubscribers];
+
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t f = 0; f < kFrames; f++){
+        src.data[0] = f;
+        typename TPool::Handle h = pool.acquire();
+        if(!h){
+            break;
+        }
+        std::memcpy(h->data, src.data, MsgType::kSize);
+        for(uint8_t i = 0; i < NSubscribers; i++){
+            subscribers[i].push(h);
+        }
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    expectNoDrop(pool.getExhaustedCount());
+    drainHandles(subscribers);
+    return nsPerFrame<std::chrono::steady_clock>(start, stop);
+}
+
+template <typename Processor, typename MsgType>
+double runParse(){
+    using TParser = microparcel::Parser<MsgType::kSize>;
+
+    typename TParser::Message_T msg;
+    fillPayload(msg);
+    typename TParser::Frame_T frame = TParser::encode(msg);
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&frame);
+
+    Processor processor;
+
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t f = 0; f < kFrames; f++){
+        for(uint8_t b = 0; b < TParser::Frame_T::FrameSize; b++){
+            processor.parse(bytes[b]);
+        }
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    expectNoDrop(processor.getDroppedCount());
+    processor.drain();
+    return nsPerFrame<std::chrono::steady_clock>(start, stop);
+}
+
+double median(double (*inRun)()){
+    double results[kRepetitions];
+
+    inRun(); // warm-up
+    for(uint8_t r = 0; r < kRepetitions; r++){
+        results[r] = inRun();
+    }
+
+    std::sort(std::begin(results), std::end(results));
+    return results[kRepetitions / 2];
+}
+
+template <uint8_t MsgSize, uint8_t NSubscribers>
+void compare(){
+    using TMsg = microparcel::Message<MsgSize>;
+
+    double fanOutCopy = median(runFanOutCopy<TMsg, NSubscribers>);
+    double fanOutHandle = median(runFanOutHandle<TMsg, NSubscribers>);
+    double parseCopy = median(runParse<CopyProcessor<TMsg, NSubscribers>, TMsg>);
+    double parseHandle = median(runParse<HandleProcessor<TMsg, NSubscribers>, TMsg>);
+
+    std::printf("%8u %12u %12.1f %12.1f %12.1f %12.1f\n", MsgSize, NSubscribers, fanOutCopy, fanOutHandle, parseCopy, parseHandle);
+}
+
+int main(){
+    std::printf("median ns/msg over %u runs of %u messages\n", kRepetitions, (unsigned)kFrames);
+    std::printf("%8s %12s %25s %25s\n", "", "", "fan-out", "parse + fan-out");
+    std::printf("%8s %12s %12s %12s %12s %12s\n", "msg size", "subscribers", "copy", "handle", "copy", "handle");
+
+    compare<8, 5>();
+    compare<8, 10>();
+    compare<32, 5>();
+    compare<32, 10>();
+    compare<128, 5>();
+    compare<128, 10>();
+
+    return 0;
+}
@@ -6,6 +6,7 @@
 #include <limits>
 #include <numeric>
 #include <iterator>
+#include <utility>
 
 namespace microparcel{
     /**
@@ -236,10 +237,41 @@ namespace microparcel{
 
 
 
+    /**
+     * Common part of the MessageProcessors: sends messages via Implementation::sendFrame
+     */
+    template <typename Implementation, typename Router, typename MsgType>
+    class MsgProcessorBase: public Router{
+        protected:
+            using TParser = microparcel::Parser<MsgType::kSize>;
+            using TFrame = typename TParser::Frame_T;
+
+        public:
+            /**
+             * Send a message generated via a Router::makeXYZ
+             */
+            void send(const MsgType &inMsg){
+                TFrame frame = mParser.encode(inMsg);
+
+                Implementation& underlying = static_cast<Implementation&>(*this);
+                underlying.sendFrame(frame);
+            }
+
+            /**
+             * interface for sending frame's bytes
+             */
+            // void Implementation::sendFrame(const TFrame &inFrame);
+
+        protected:
+            TParser mParser;
+    };
+
+
+
     /**
      * A hardware abstracted implementation of a MessageProcessor.
      * parse byte from hardware to route the message to the generated microparcel Router. (processXYZ(...) )
-     * a send method makes the frame from message and send bytes via pure virtual sendFrame
+     * a send method makes the frame from message and send bytes via Implementation::sendFrame
      * 
      * sendFrame must be implemented, in Implementation. 
      * It sends data on the bus in microparcel format.
@@ -248,8 +280,8 @@ namespace microparcel{
      * 
      * Usage:
      * class ZeProcessor: public microparcel::MsgProcessor<ZeProcessor, ZeRouter, ZeMessage >{
-     *   virtual void sendFrame(uint8_t *buffer, uint8_t buffer_size){
-     *      // send data to the Bus, UART, etc...
+     *   void sendFrame(const microparcel::Frame<ZeMessage::kSize> &inFrame){
+     *      // send data to the Bus, UART, etc... ((const uint8_t*)&inFrame, Frame<ZeMessage::kSize>::FrameSize)
      *   }
      * 
      *   void run(){
@@ -260,39 +292,292 @@ namespace microparcel{
      * 
      */
     template <typename Implementation, typename Router, typename MsgType>
-    class MsgProcessor: public Router{
-        using TParser = microparcel::Parser<MsgType::kSize>;
-        using TFrame = typename TParser::Frame_T;
+    class MsgProcessor: public MsgProcessorBase<Implementation, Router, MsgType>{
+        using TParser = typename MsgProcessorBase<Implementation, Router, MsgType>::TParser;
 
         public:
             /**
-             * Send a message generated via a Router::makeXYZ
+             * Parse a byte with microparcel::Parser, and process it with the given Router
              */
-            void send(const MsgType &inMsg){
-                TFrame frame = mParser.encode(inMsg);
+            void parse(uint8_t inByte){
+                typename TParser::Status status = this->mParser.parse(inByte, &mMsgRecv);
+                if(status == TParser::eComplete){
+                    this->process(mMsgRecv);
+                }
+            }
 
-                Implementation& underlying = static_cast<Implementation&>(*this);
-                underlying.sendFrame(frame);
+        private:
+            MsgType mMsgRecv;
+    };
+
+
+
+    /**
+     * \brief a statically sized pool of Messages, shared via reference-counted handles
+     * No dynamic allocation: the slots are part of the pool object.
+     * A slot goes back to the pool when its last Handle is dropped.
+     * When the pool is empty, acquire() returns an invalid Handle and the exhaustion counter is incremented.
+     *
+     * Not thread safe: acquiring and dropping handles must be done from a single context
+     * (or under a critical section).
+     * Handles must not outlive their pool.
+     *
+     * \tparam MsgType the Message type stored in the slots
+     * \tparam PoolSize the number of slots
+     */
+    template <typename MsgType, uint8_t PoolSize>
+    class MessagePool{
+        static_assert(PoolSize > 0, "Pool can't be empty");
+
+        struct Slot{
+            MsgType message;
+            MessagePool *owner;
+            uint8_t refs;
+            Slot *next;
+        };
+
+        public:
+            static const uint8_t kSize = PoolSize;
+            static const uint8_t kMaxRefs = std::numeric_limits<uint8_t>::max();
+
+            /**
+             * \brief a shared reference on a pool slot
+             * Copying a Handle only increments the slot reference count.
+             * A slot is shared by at most kMaxRefs handles: beyond that, the copy is an invalid Handle
+             * and the failure is counted in getRefOverflowCount().
+             */
+            class Handle{
+                public:
+                    Handle(): mSlot(nullptr){}
+
+                    Handle(const Handle &inOther): mSlot(inOther.mSlot){
+                        if(mSlot){
+                            if(mSlot->refs == kMaxRefs){
+                                mSlot->owner->mRefOverflowCount++;
+                                mSlot = nullptr;
+                            }
+                            else{
+                                mSlot->refs++;
+                            }
+                        }
+                    }
+
+                    Handle(Handle &&inOther): mSlot(inOther.mSlot){
+                        inOther.mSlot = nullptr;
+                    }
+
+                    Handle& operator=(Handle inOther){
+                        Slot *tmp = mSlot;
+                        mSlot = inOther.mSlot;
+                        inOther.mSlot = tmp;
+                        return *this;
+                    }
+
+                    ~Handle(){
+                        reset();
+                    }
+
+                    /**
+                     * drop the reference, the slot is released if it was the last one
+                     */
+                    void reset(){
+                        if(mSlot){
+                            if(--mSlot->refs == 0){
+                                mSlot->owner->release(mSlot);
+                            }
+                            mSlot = nullptr;
+                        }
+                    }
+
+                    bool isValid() const { return mSlot != nullptr; }
+                    explicit operator bool() const { return isValid(); }
+
+                    /**
+                     * number of Handles sharing the slot, 0 for an invalid Handle
+                     */
+                    uint8_t useCount() const { return mSlot ? mSlot->refs : 0; }
+
+                    MsgType& operator*() const { return mSlot->message; }
+                    MsgType* operator->() const { return &mSlot->message; }
+
+                private:
+                    friend class MessagePool;
+
+                    // takes over the reference set by MessagePool::acquire
+                    explicit Handle(Slot *inSlot): mSlot(inSlot){}
+
+                    Slot *mSlot;
+            };
+
+            MessagePool(): mFree(nullptr), mAvailable(PoolSize), mExhaustedCount(0), mRefOverflowCount(0){
+                for(uint8_t i = PoolSize; i > 0; i--){
+                    Slot &slot = mSlots[i-1];
+                    slot.owner = this;
+                    slot.refs = 0;
+                    slot.next = mFree;
+                    mFree = &slot;
+                }
             }
 
+            // slots point back to their pool
+            MessagePool(const MessagePool&) = delete;
+            MessagePool& operator=(const MessagePool&) = delete;
+
             /**
-             * interface for sending frame's bytes
+             * \brief takes a free slot
+             * \return a Handle on the slot, or an invalid Handle if the pool is exhausted
+             * The content of the Message is left as is from its previous use.
+             */
+            Handle acquire(){
+                if(mFree == nullptr){
+                    mExhaustedCount++;
+                    return Handle();
+                }
+
+                Slot *slot = mFree;
+                mFree = slot->next;
+                slot->refs = 1;
+                mAvailable--;
+
+                return Handle(slot);
+            }
+
+            /**
+             * number of free slots
              */
-            // protected void Implementation::sendFrame(const TFrame &inFrame);
+            uint8_t available() const { return mAvailable; }
+
+            /**
+             * number of acquire() calls that found the pool empty
+             */
+            uint32_t getExhaustedCount() const { return mExhaustedCount; }
+            void resetExhaustedCount(){ mExhaustedCount = 0; }
+
+            /**
+             * number of Handle copies refused because the slot already had kMaxRefs handles
+             */
+            uint32_t getRefOverflowCount() const { return mRefOverflowCount; }
+            void resetRefOverflowCount(){ mRefOverflowCount = 0; }
+
+        private:
+            void release(Slot *inSlot){
+                inSlot->next = mFree;
+                mFree = inSlot;
+                mAvailable++;
+            }
+
+            Slot mSlots[PoolSize];
+            Slot *mFree;
+            uint8_t mAvailable;
+            uint32_t mExhaustedCount;
+            uint32_t mRefOverflowCount;
+    };
+
+
+
+    /**
+     * What a PooledMsgProcessor does with a frame received while its pool is exhausted.
+     * In both cases the frame is dropped and counted (see PooledMsgProcessor::getDroppedCount)
+     */
+    enum ExhaustionPolicy{
+        eDropFrame = 0,     // silently drop the frame
+        eNotifyDrop         // drop the frame and call Implementation::poolExhausted()
+    };
+
+    template <ExhaustionPolicy Policy>
+    struct ExhaustionNotifier{
+        template <typename Implementation>
+        static void notify(Implementation &){}
+    };
+
+    template <>
+    struct ExhaustionNotifier<eNotifyDrop>{
+        template <typename Implementation>
+        static void notify(Implementation &inImpl){
+            inImpl.poolExhausted();
+        }
+    };
+
+
+
+    /**
+     * A MsgProcessor that decodes messages directly into the slots of a MessagePool.
+     * The Router API is unchanged: process(MsgType&) is called with the pooled message.
+     * A processXYZ handler that needs to keep the message (queue, forward it to several subscribers...)
+     * calls retainReceived() to get a Handle instead of copying the message;
+     * the slot is released when the last Handle is dropped.
+     *
+     * A slot is reserved when a start-of-frame byte is parsed while the Parser is between frames.
+     * If none is free, the frame is parsed anyway, then dropped according to Policy.
+     * send() and sendFrame work as in MsgProcessor.
+     *
+     * Usage:
+     * class ZeProcessor: public microparcel::PooledMsgProcessor<ZeProcessor, ZeRouter, ZeMessage, 8>{
+     *   void processXYZ(ZeMessage &msg){
+     *      Handle h = retainReceived();
+     *      subscriberA.push(h);
+     *      subscriberB.push(h);
+     *   }
+     * }
+     */
+    template <typename Implementation, typename Router, typename MsgType, uint8_t PoolSize, ExhaustionPolicy Policy = eDropFrame>
+    class PooledMsgProcessor: public MsgProcessorBase<Implementation, Router, MsgType>{
+        using TParser = typename MsgProcessorBase<Implementation, Router, MsgType>::TParser;
+        using TFrame = typename MsgProcessorBase<Implementation, Router, MsgType>::TFrame;
+
+        public:
+            using Pool_T = MessagePool<MsgType, PoolSize>;
+            using Handle = typename Pool_T::Handle;
+
+            PooledMsgProcessor(): mStatus(TParser::eComplete), mDroppedCount(0){}
 
             /**
              * Parse a byte with microparcel::Parser, and process it with the given Router
              */
             void parse(uint8_t inByte){
-                typename TParser::Status status = mParser.parse(inByte, &mMsgRecv);
-                if(status == TParser::eComplete){
-                    this->process(mMsgRecv);
+                // only a SOF received between frames starts a new frame
+                if(!mMsgRecv && mStatus != TParser::eNotComplete && inByte == TFrame::kSOF){
+                    mMsgRecv = mPool.acquire();
+                }
+
+                MsgType *target = mMsgRecv ? &*mMsgRecv : &mMsgDropped;
+
+                mStatus = this->mParser.parse(inByte, target);
+                if(mStatus == TParser::eComplete){
+                    if(mMsgRecv){
+                        mMsgProcessed = std::move(mMsgRecv);
+                        this->process(*mMsgProcessed);
+                        mMsgProcessed.reset();
+                    }
+                    else{
+                        mDroppedCount++;
+                        ExhaustionNotifier<Policy>::notify(static_cast<Implementation&>(*this));
+                    }
                 }
             }
 
+            /**
+             * a Handle on the message being processed; invalid outside of Router::process,
+             * or if the message already has MessagePool::kMaxRefs handles
+             */
+            Handle retainReceived() const { return mMsgProcessed; }
+
+            const Pool_T& getPool() const { return mPool; }
+
+            /**
+             * number of complete frames dropped because the pool was exhausted
+             */
+            uint32_t getDroppedCount() const { return mDroppedCount; }
+            void resetDroppedCount(){ mDroppedCount = 0; }
+
         private:
-            TParser mParser;
-            MsgType mMsgRecv;
+            typename TParser::Status mStatus;
+            Pool_T mPool;
+
+            Handle mMsgRecv;
+            Handle mMsgProcessed;
+            MsgType mMsgDropped;
+            uint32_t mDroppedCount;
     };
 };
 
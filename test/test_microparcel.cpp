@@ -17,10 +17,12 @@
 #include "test_up_message.h"
 #include "test_up_parser.h"
 #include "test_processor.h"
+#include "test_pool.h"
 
 CPPUNIT_TEST_SUITE_REGISTRATION( MicroParcelMessageTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( MicroParcelParserTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( MicroParcelProcessorTest );
+CPPUNIT_TEST_SUITE_REGISTRATION( MicroParcelPoolTest );
 
 int main(){
     // informs test-listener about testresults
@@ -0,0 +1,279 @@
+#ifndef TEST_POOL_H
+#define TEST_POOL_H
+
+#include <cppunit/TestCase.h>
+#include <cppunit/TestFixture.h>
+
+#include "microparcel.h"
+
+
+template<uint8_t Size>
+class tMessage3 : public microparcel::Message<Size>{
+    public:
+        uint8_t getByte(uint8_t b) {
+            return this->data[b];
+        }
+
+        void setByte(uint8_t b, uint8_t data){
+            this->data[b] = data;
+        }
+
+};
+
+
+
+template <typename Implementation, typename MsgType>
+class FanOutRouter{
+    public:
+        void process(MsgType &msg){
+            static_cast<Implementation&>(*this).dispatch(msg);
+        }
+};
+
+template <typename MsgType, microparcel::ExhaustionPolicy Policy>
+class PooledProcessor: public microparcel::PooledMsgProcessor<PooledProcessor<MsgType, Policy>, FanOutRouter<PooledProcessor<MsgType, Policy>, MsgType>, MsgType, 2, Policy>{
+    public:
+        using Base = microparcel::PooledMsgProcessor<PooledProcessor<MsgType, Policy>, FanOutRouter<PooledProcessor<MsgType, Policy>, MsgType>, MsgType, 2, Policy>;
+        using Handle = typename Base::Handle;
+
+        PooledProcessor(): processed(0), exhausted(0){}
+
+        void dispatch(MsgType &msg){
+            processed++;
+
+            // fan-out to two subscribers
+            subscriberA = this->retainReceived();
+            subscriberB = this->retainReceived();
+
+            CPPUNIT_ASSERT(&(*subscriberA) == &msg);
+            CPPUNIT_ASSERT(subscriberA.useCount() == 3);
+        }
+
+        void poolExhausted(){
+            exhausted++;
+        }
+
+        void sendFrame(const microparcel::Frame<MsgType::kSize> &inFrame){
+            sent = inFrame;
+        }
+
+        void feed(uint8_t b0, uint8_t b1, uint8_t b2){
+            this->parse(0xAA);
+            this->parse(b0);
+            this->parse(b1);
+            this->parse(b2);
+            this->parse(0xFF & (0xAA + b0 + b1 + b2));
+        }
+
+        Handle subscriberA;
+        Handle subscriberB;
+        microparcel::Frame<MsgType::kSize> sent;
+        uint8_t processed;
+        uint8_t exhausted;
+};
+
+
+class MicroParcelPoolTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(MicroParcelPoolTest);
+    CPPUNIT_TEST(testAcquireRelease);
+    CPPUNIT_TEST(testExhaustion);
+    CPPUNIT_TEST(testRefOverflow);
+    CPPUNIT_TEST(testProcessorFanOut);
+    CPPUNIT_TEST(testProcessorDrop);
+    CPPUNIT_TEST(testProcessorDropSOFPayload);
+    CPPUNIT_TEST(testProcessorSend);
+    CPPUNIT_TEST_SUITE_END();
+
+    public:
+        using tPool = microparcel::MessagePool<tMessage3<3>, 2>;
+
+        void setUp(){
+        }
+
+        void tearDown(){
+        }
+
+    protected:
+        void testAcquireRelease(){
+            tPool pool;
+            CPPUNIT_ASSERT(pool.available() == 2);
+
+            tPool::Handle h1 = pool.acquire();
+            CPPUNIT_ASSERT(h1.isValid());
+            CPPUNIT_ASSERT(h1.useCount() == 1);
+            CPPUNIT_ASSERT(pool.available() == 1);
+
+            h1->setByte(0, 0x42);
+
+            {
+                tPool::Handle h2 = h1;
+                tPool::Handle h3;
+                h3 = h2;
+                CPPUNIT_ASSERT(h1.useCount() == 3);
+                CPPUNIT_ASSERT(h3->getByte(0) == 0x42);
+                CPPUNIT_ASSERT(pool.available() == 1);
+            }
+            CPPUNIT_ASSERT(h1.useCount() == 1);
+
+            tPool::Handle h4 = std::move(h1);
+            CPPUNIT_ASSERT(!h1.isValid());
+            CPPUNIT_ASSERT(h4.useCount() == 1);
+
+            h4.reset();
+            CPPUNIT_ASSERT(!h4.isValid());
+            CPPUNIT_ASSERT(pool.available() == 2);
+        }
+
+        void testExhaustion(){
+            tPool pool;
+
+            tPool::Handle h1 = pool.acquire();
+            tPool::Handle h2 = pool.acquire();
+            CPPUNIT_ASSERT(pool.available() == 0);
+            CPPUNIT_ASSERT(pool.getExhaustedCount() == 0);
+
+            tPool::Handle h3 = pool.acquire();
+            CPPUNIT_ASSERT(!h3.isValid());
+            CPPUNIT_ASSERT(pool.getExhaustedCount() == 1);
+
+            // released slot is reused
+            h1.reset();
+            h3 = pool.acquire();
+            CPPUNIT_ASSERT(h3.isValid());
+            CPPUNIT_ASSERT(pool.getExhaustedCount() == 1);
+
+            pool.resetExhaustedCount();
+            CPPUNIT_ASSERT(pool.getExhaustedCount() == 0);
+        }
+
+        void testRefOverflow(){
+            tPool pool;
+
+            tPool::Handle h1 = pool.acquire();
+            tPool::Handle copies[tPool::kMaxRefs - 1];
+            for(uint8_t i = 0; i < tPool::kMaxRefs - 1; i++){
+                copies[i] = h1;
+            }
+            CPPUNIT_ASSERT(h1.useCount() == tPool::kMaxRefs);
+            CPPUNIT_ASSERT(pool.getRefOverflowCount() == 0);
+
+            // one copy too many
+            tPool::Handle extra = h1;
+            CPPUNIT_ASSERT(!extra.isValid());
+            CPPUNIT_ASSERT(h1.useCount() == tPool::kMaxRefs);
+            CPPUNIT_ASSERT(pool.getRefOverflowCount() == 1);
+            CPPUNIT_ASSERT(pool.getExhaustedCount() == 0);
+
+            // the slot stays in use as long as a handle remains
+            for(uint8_t i = 0; i < tPool::kMaxRefs - 1; i++){
+                copies[i].reset();
+            }
+            CPPUNIT_ASSERT(h1.useCount() == 1);
+            CPPUNIT_ASSERT(pool.available() == 1);
+
+            h1.reset();
+            CPPUNIT_ASSERT(pool.available() == 2);
+
+            pool.resetRefOverflowCount();
+            CPPUNIT_ASSERT(pool.getRefOverflowCount() == 0);
+        }
+
+        void testProcessorFanOut(){
+            PooledProcessor<tMessage3<3>, microparcel::eDropFrame> processor;
+
+            processor.feed(0x01, 0x02, 0x03);
+            CPPUNIT_ASSERT(processor.processed == 1);
+            CPPUNIT_ASSERT(processor.subscriberA.useCount() == 2);
+            CPPUNIT_ASSERT(processor.subscriberB->getByte(2) == 0x03);
+            CPPUNIT_ASSERT(processor.getPool().available() == 1);
+
+            // the previous message is released when the subscribers take the new one
+            processor.feed(0x04, 0x05, 0x06);
+            CPPUNIT_ASSERT(processor.processed == 2);
+            CPPUNIT_ASSERT(processor.subscriberA->getByte(0) == 0x04);
+            CPPUNIT_ASSERT(processor.getPool().available() == 1);
+            CPPUNIT_ASSERT(processor.getDroppedCount() == 0);
+        }
+
+        void testProcessorDrop(){
+            PooledProcessor<tMessage3<3>, microparcel::eNotifyDrop> processor;
+
+            processor.feed(0x01, 0x02, 0x03);
+
+            // subscribers keep the only free slot busy
+            microparcel::MessagePool<tMessage3<3>, 2>::Handle held = processor.subscriberA;
+            processor.subscriberA.reset();
+            processor.subscriberB.reset();
+            processor.feed(0x04, 0x05, 0x06);
+            CPPUNIT_ASSERT(processor.processed == 2);
+
+            // both slots are held: the frame is dropped
+            processor.feed(0x07, 0x08, 0x09);
+            CPPUNIT_ASSERT(processor.processed == 2);
+            CPPUNIT_ASSERT(processor.getDroppedCount() == 1);
+            CPPUNIT_ASSERT(processor.exhausted == 1);
+            CPPUNIT_ASSERT(processor.getPool().getExhaustedCount() == 1);
+            CPPUNIT_ASSERT(held->getByte(0) == 0x01);
+            CPPUNIT_ASSERT(processor.subscriberA->getByte(0) == 0x04);
+
+            // a slot is free again
+            held.reset();
+            processor.feed(0x0A, 0x0B, 0x0C);
+            CPPUNIT_ASSERT(processor.processed == 3);
+            CPPUNIT_ASSERT(processor.subscriberA->getByte(0) == 0x0A);
+            CPPUNIT_ASSERT(processor.getDroppedCount() == 1);
+        }
+
+        void testProcessorDropSOFPayload(){
+            PooledProcessor<tMessage3<3>, microparcel::eDropFrame> processor;
+
+            processor.feed(0x01, 0x02, 0x03);
+            microparcel::MessagePool<tMessage3<3>, 2>::Handle held = processor.subscriberA;
+            processor.feed(0x04, 0x05, 0x06);
+
+            // pool exhausted: SOF values in the payload don't start a new frame
+            processor.parse(0xAA);
+            processor.parse(0xAA);
+            held.reset();   // a slot is freed in the middle of the frame
+            processor.parse(0xAA);
+            processor.parse(0xAA);
+            processor.parse(0xFF & (0xAA * 4));
+
+            CPPUNIT_ASSERT(processor.processed == 2);
+            CPPUNIT_ASSERT(processor.getDroppedCount() == 1);
+            CPPUNIT_ASSERT(processor.getPool().getExhaustedCount() == 1);
+
+            // next frame takes the freed slot
+            processor.feed(0x07, 0x08, 0x09);
+            CPPUNIT_ASSERT(processor.processed == 3);
+            CPPUNIT_ASSERT(processor.subscriberA->getByte(0) == 0x07);
+        }
+
+        void testProcessorSend(){
+            PooledProcessor<tMessage3<3>, microparcel::eDropFrame> processor;
+
+            tMessage3<3> msg;
+            msg.setByte(0, 0x81);
+            msg.setByte(1, 0xAA);
+            msg.setByte(2, 0x83);
+            processor.send(msg);
+
+            const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&processor.sent);
+            CPPUNIT_ASSERT(bytes[0] == 0xAA);
+            CPPUNIT_ASSERT(bytes[1] == 0x81);
+            CPPUNIT_ASSERT(bytes[2] == 0xAA);
+            CPPUNIT_ASSERT(bytes[3] == 0x83);
+            CPPUNIT_ASSERT(bytes[4] == ((0xAA + 0x81 + 0xAA + 0x83) & 0xFF));
+
+            // round trip
+            for(uint8_t i = 0; i < microparcel::Frame<3>::FrameSize; i++){
+                processor.parse(bytes[i]);
+            }
+            CPPUNIT_ASSERT(processor.processed == 1);
+            CPPUNIT_ASSERT(processor.subscriberA->getByte(0) == 0x81);
+            CPPUNIT_ASSERT(processor.subscriberA->getByte(1) == 0xAA);
+            CPPUNIT_ASSERT(processor.subscriberA->getByte(2) == 0x83);
+        }
+};
+
+#endif //TEST_POOL_H
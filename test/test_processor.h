@@ -36,7 +36,9 @@ class DummyRouter{
 template <typename MsgType>
 class DummyProcessor: public microparcel::MsgProcessor<DummyProcessor<MsgType>, DummyRouter<MsgType>, MsgType >{
     public:
-        virtual void sendFrame(uint8_t *buffer, uint8_t buffer_size){
+        void sendFrame(const microparcel::Frame<MsgType::kSize> &inFrame){
+            const uint8_t *buffer = reinterpret_cast<const uint8_t*>(&inFrame);
+            uint8_t buffer_size = microparcel::Frame<MsgType::kSize>::FrameSize;
             CPPUNIT_ASSERT(buffer_size == 5);
 
             CPPUNIT_ASSERT(buffer[0] == 0xAA);